@@ -4,6 +4,13 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <tuple>
+#include <future>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
@@ -12,11 +19,15 @@ struct Node
     int data;
     Node *left;
     Node *right;
+    Node *parent; // lets iterators walk in-order without a stack
+    std::atomic<int> refs; // parent links and roots (live tree or snapshots) pointing here
 
-    Node(int x)
+    Node(int x, Node *p = nullptr)
     {
         data = x;
         left = right = nullptr;
+        parent = p;
+        refs = 1;
     }
 };
 
@@ -79,9 +90,50 @@ private:
     }
 };
 
+/**
+ * Shape summary of a BST, filled in by a single traversal (see Bst::shape()).
+ *
+ * Depths count edges from the root, so the root has depth 0.
+ */
+struct ShapeStats
+{
+    long long nodes = 0;
+    long long ipl = 0;                  // sum of the depths of all nodes
+    long long epl = 0;                  // sum of the depths of all null links (= ipl + 2 * nodes)
+    int height = -1;                    // deepest node, -1 for an empty tree
+    long long leaves = 0;               // nodes with no children
+    std::vector<long long> depthHistogram; // depthHistogram[d] = nodes at depth d
+    double optimalRatio = 1.0;          // ipl / ipl of a perfectly balanced tree of the same size
+    double randomRatio = 1.0;           // ipl / expected ipl of a random BST of the same size
+
+private:
+    friend class Bst;
+
+    // Adds the raw counters of a partial result; Bst fills in the derived
+    // fields (epl, height, ratios) once every part has been merged.
+    void merge(const ShapeStats &other)
+    {
+        nodes += other.nodes;
+        ipl += other.ipl;
+        leaves += other.leaves;
+        if (other.depthHistogram.size() > depthHistogram.size())
+        {
+            depthHistogram.resize(other.depthHistogram.size(), 0);
+        }
+        for (size_t d = 0; d < other.depthHistogram.size(); d++)
+        {
+            depthHistogram[d] += other.depthHistogram[d];
+        }
+    }
+};
+
 class Bst
 {
     Node *root;
+    long long count; // number of nodes, kept up to date by _insert and _delete
+
+    // Trees at least this large are measured by shape() on several threads
+    static const long long PARALLEL_SHAPE_THRESHOLD = 1 << 16;
 
     void _print(Node *subroot)
     {
@@ -96,21 +148,135 @@ class Bst
             _print(subroot->right);
         }
     }
-    void _insert(Node *&subroot, int x)
+    static const Node *_leftmost(const Node *subroot)
+    {
+        while (subroot && subroot->left)
+        {
+            subroot = subroot->left;
+        }
+        return subroot;
+    }
+
+    static const Node *_rightmost(const Node *subroot)
+    {
+        while (subroot && subroot->right)
+        {
+            subroot = subroot->right;
+        }
+        return subroot;
+    }
+
+    /**
+     * Returns the in-order successor of a node, or nullptr if it is the maximum.
+     * Walking the whole tree this way touches every edge twice, so advancing
+     * an iterator is amortized O(1).
+     */
+    static const Node *_successor(const Node *node)
+    {
+        if (node->right)
+        {
+            return _leftmost(node->right);
+        }
+        while (node->parent && node == node->parent->right)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    static const Node *_predecessor(const Node *node)
+    {
+        if (node->left)
+        {
+            return _rightmost(node->left);
+        }
+        while (node->parent && node == node->parent->left)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    /**
+     * Drops one reference to a node, freeing it (and, in turn, releasing its
+     * children) once nothing points at it any more. Safe to call from any thread.
+     */
+    static void _release(Node *node)
+    {
+        vector<Node *> pending;
+        while (node || !pending.empty())
+        {
+            if (!node)
+            {
+                node = pending.back();
+                pending.pop_back();
+            }
+            if (node->refs.fetch_sub(1, memory_order_acq_rel) != 1)
+            {
+                node = nullptr;
+                continue;
+            }
+            if (node->right)
+            {
+                pending.push_back(node->right);
+            }
+            Node *next = node->left;
+            delete node;
+            node = next;
+        }
+    }
+
+    /**
+     * Makes subroot safe to modify: if a snapshot still shares it, it is
+     * replaced in the live tree by a private copy that shares both children.
+     * Every function that writes through a Node*& calls this on the way down,
+     * so an update copies at most the path from the root (O(depth)) and only
+     * while a snapshot of that path is alive.
+     *
+     * Parent links belong to the live tree; snapshots never read them, so
+     * re-pointing the children's parent at the copy does not disturb readers.
+     */
+    static void _own(Node *&subroot)
+    {
+        if (!subroot || subroot->refs.load(memory_order_acquire) == 1)
+        {
+            return;
+        }
+        Node *shared = subroot;
+        Node *copy = new Node(shared->data, shared->parent);
+        copy->left = shared->left;
+        copy->right = shared->right;
+        if (copy->left)
+        {
+            copy->left->refs.fetch_add(1, memory_order_relaxed);
+            copy->left->parent = copy;
+        }
+        if (copy->right)
+        {
+            copy->right->refs.fetch_add(1, memory_order_relaxed);
+            copy->right->parent = copy;
+        }
+        subroot = copy;
+        _release(shared);
+    }
+
+    void _insert(Node *&subroot, int x, Node *parent = nullptr)
     {
         if (!subroot)
         { // if(root == nullptr)
-            subroot = new Node(x);
+            subroot = new Node(x, parent);
+            count++;
         }
         else
         {
+            _own(subroot);
             if (x < subroot->data)
             {
-                _insert(subroot->left, x);
+                _insert(subroot->left, x, subroot);
             }
             else
             {
-                _insert(subroot->right, x);
+                _insert(subroot->right, x, subroot);
             }
         }
     }
@@ -129,6 +295,7 @@ class Bst
             cout << "Number not found" << endl;
             return;
         }
+        _own(subroot);
         if (x < subroot->data)
         {
             // If the value to delete is less than the current node's value,
@@ -149,20 +316,25 @@ class Bst
                 // If the node has no children, simply delete it.
                 delete subroot;
                 subroot = nullptr;
+                count--;
             }
             else if (!subroot->left)
             {
                 // If the node has only a right child, replace it with the right child.
                 Node *temp = subroot;
                 subroot = subroot->right;
+                subroot->parent = temp->parent;
                 delete temp;
+                count--;
             }
             else if (!subroot->right)
             {
                 // If the node has only a left child, replace it with the left child.
                 Node *temp = subroot;
                 subroot = subroot->left;
+                subroot->parent = temp->parent;
                 delete temp;
+                count--;
             }
             else
             {
@@ -180,15 +352,125 @@ class Bst
             }
         }
     }
-    int _ipl(Node *root, int depth = 0)
+    static void _visit(const Node *node, int depth, ShapeStats &stats)
+    {
+        stats.nodes++;
+        stats.ipl += depth;
+        if (depth >= (int)stats.depthHistogram.size())
+        {
+            stats.depthHistogram.resize(depth + 1, 0);
+        }
+        stats.depthHistogram[depth]++;
+        if (!node->left && !node->right)
+        {
+            stats.leaves++;
+        }
+    }
+
+    /**
+     * Accumulates the shape of a subtree into stats with one iterative
+     * pre-order walk. The explicit stack only ever holds one pending right
+     * child per level, so it stays O(height) and is reused across nodes.
+     *
+     * @param subroot The subtree to measure.
+     * @param depth Depth of subroot within the whole tree.
+     * @param stats Accumulator to add into.
+     */
+    static void _shape(const Node *subroot, int depth, ShapeStats &stats)
+    {
+        vector<pair<const Node *, int>> stack;
+        stack.reserve(64);
+        if (subroot)
+        {
+            stack.push_back({subroot, depth});
+        }
+        while (!stack.empty())
+        {
+            const Node *node = stack.back().first;
+            int d = stack.back().second;
+            stack.pop_back();
+            // Follow left links directly so only right children hit the stack
+            while (node)
+            {
+                _visit(node, d, stats);
+                if (node->right)
+                {
+                    stack.push_back({node->right, d + 1});
+                }
+                node = node->left;
+                d++;
+            }
+        }
+    }
+
+    /**
+     * Same as _shape(subroot, 0, stats), but the top of the tree is expanded on
+     * this thread until there is one subtree per hardware thread, and those
+     * subtrees are then measured concurrently and merged.
+     */
+    static void _shapeParallel(const Node *subroot, ShapeStats &stats)
+    {
+        size_t workers = max(2u, thread::hardware_concurrency());
+        vector<pair<const Node *, int>> frontier;
+        frontier.push_back({subroot, 0});
+
+        // Stop after a few levels so a degenerate (list-like) tree does not
+        // end up being walked level by level here.
+        for (int level = 0; level < 16 && !frontier.empty() && frontier.size() < workers; level++)
+        {
+            vector<pair<const Node *, int>> next;
+            for (auto &entry : frontier)
+            {
+                _visit(entry.first, entry.second, stats);
+                if (entry.first->left)
+                    next.push_back({entry.first->left, entry.second + 1});
+                if (entry.first->right)
+                    next.push_back({entry.first->right, entry.second + 1});
+            }
+            frontier.swap(next);
+        }
+
+        vector<future<ShapeStats>> tasks;
+        for (auto &entry : frontier)
+        {
+            tasks.push_back(async(launch::async, [entry]()
+                                  {
+                                      ShapeStats partial;
+                                      _shape(entry.first, entry.second, partial);
+                                      return partial; }));
+        }
+        for (auto &task : tasks)
+        {
+            stats.merge(task.get());
+        }
+    }
+
+    /**
+     * IPL of the most balanced tree with n nodes: sum of floor(log2 k) for k = 1..n.
+     */
+    static long long _optimalIpl(long long n)
+    {
+        long long total = 0;
+        for (long long level = 0, first = 1; first <= n; level++, first *= 2)
+        {
+            // Nodes first .. 2*first-1 (1-based, level order) sit at depth `level`
+            long long last = min(n, 2 * first - 1);
+            total += level * (last - first + 1);
+        }
+        return total;
+    }
+
+    /**
+     * Expected IPL of a BST built from n random insertions: 2(n+1)H(n) - 4n.
+     */
+    static double _randomIpl(long long n)
     {
-        if (!root)
-            return 0; // Base case: Empty subtree contributes 0 to IPL
-        if (!root->left && !root->right)
-        {                     // If the node is a leaf node
-            return depth - 2; // Subtract 2 from the depth
+        double harmonic = 0.0;
+        for (long long k = 1; k <= n; k++)
+        {
+            harmonic += 1.0 / k;
         }
-        return depth + _ipl(root->left, depth + 1) + _ipl(root->right, depth + 1);
+        return 2.0 * (n + 1) * harmonic - 4.0 * n;
     }
 
     bool _unique_value(int *arr, int n, int x)
@@ -212,6 +494,7 @@ class Bst
         {
             return accumulator;
         }
+        _own(subroot);
 
         if (subroot->data < random_Node)
         {
@@ -255,6 +538,7 @@ class Bst
         {
             return;
         }
+        _own(subroot);
 
         if (subroot->data < random_Node)
         {
@@ -324,11 +608,163 @@ class Bst
     }
 
 public:
-    Bst() { root = nullptr; }
+    /**
+     * Bidirectional in-order iterator over the keys of the tree.
+     *
+     * Keys are read-only since changing one in place would break the BST
+     * ordering. The iterator is just a node pointer plus the owning tree
+     * (so that --end() can find the maximum); it never allocates.
+     *
+     * Iterators and Ranges are only valid until the next insert or delete.
+     * While a snapshot is alive, an update copies every node on its path from
+     * the root, so iterators to keys that were never removed can be left on
+     * the old copies, which are freed once the snapshot goes away. Readers
+     * that need a stable view during mutation should iterate a Snapshot.
+     */
+    class const_iterator
+    {
+        friend class Bst;
+
+        const Node *node;
+        const Bst *tree;
+
+        const_iterator(const Node *n, const Bst *t) : node(n), tree(t) {}
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int *;
+        using reference = const int &;
+
+        const_iterator() : node(nullptr), tree(nullptr) {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator &operator++()
+        {
+            node = _successor(node);
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        const_iterator &operator--()
+        {
+            // end() is represented by nullptr, so stepping back lands on the maximum
+            node = node ? _predecessor(node) : _rightmost(tree->root);
+            return *this;
+        }
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator &other) const { return node == other.node; }
+        bool operator!=(const const_iterator &other) const { return node != other.node; }
+    };
+    using iterator = const_iterator;
+
+    /**
+     * A half-open [first, last) slice of the tree usable with range-for.
+     */
+    struct Range
+    {
+        const_iterator first;
+        const_iterator last;
+
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+    };
+
+    Bst()
+    {
+        root = nullptr;
+        count = 0;
+    }
+    ~Bst()
+    {
+        if (root)
+        {
+            _release(root);
+        }
+    }
+    // Nodes are shared only through snapshot(); copying a tree is not supported
+    Bst(const Bst &) = delete;
+    Bst &operator=(const Bst &) = delete;
     void insert(int x) { _insert(root, x); }
     bool search(int key) { return 0; }
     void deleteNode(int x) { _delete(root, x); }
     void print() { _print(root); }
+
+    const_iterator begin() const { return const_iterator(_leftmost(root), this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+
+    /**
+     * Returns an iterator to the first key that is not less than x,
+     * or end() if every key is smaller.
+     */
+    const_iterator lower_bound(int x) const
+    {
+        const Node *result = nullptr;
+        const Node *current = root;
+        while (current)
+        {
+            if (current->data < x)
+            {
+                current = current->right;
+            }
+            else
+            {
+                result = current;
+                current = current->left;
+            }
+        }
+        return const_iterator(result, this);
+    }
+
+    /**
+     * Returns an iterator to the first key that is greater than x,
+     * or end() if no key is larger.
+     */
+    const_iterator upper_bound(int x) const
+    {
+        const Node *result = nullptr;
+        const Node *current = root;
+        while (current)
+        {
+            if (current->data <= x)
+            {
+                current = current->right;
+            }
+            else
+            {
+                result = current;
+                current = current->left;
+            }
+        }
+        return const_iterator(result, this);
+    }
+
+    /**
+     * Returns the keys k with a <= k < b in ascending order, e.g.
+     *
+     *     for (int key : tree.range(100, 200)) { ... }
+     */
+    Range range(int a, int b) const
+    {
+        if (b <= a)
+        {
+            return Range{end(), end()};
+        }
+        return Range{lower_bound(a), lower_bound(b)};
+    }
     void saveDotFile(const std::string &filename)
     {
         std::string dotContent = GraphvizBST::generateDot(root);
@@ -369,13 +805,554 @@ public:
      * IPL = (depth of 10) + (depth of 5) + (depth of 15) + (depth of 2) + (depth of 7) + (depth of 20)
      *     = 0 + 1 + 1 + 2 + 2 + 2 = 8
      *
-     * @param root Pointer to the root node of the BST.
-     * @param depth Current depth of the node (default is 0 for the root call).
      * @return The sum of depths of all nodes (Internal Path Length).
      */
     int ipl()
     {
-        return _ipl(root);
+        return (int)shape().ipl;
+    }
+
+    /**
+     * Number of edges on the longest root-to-leaf path (-1 for an empty tree).
+     */
+    int height()
+    {
+        return shape().height;
+    }
+
+    /**
+     * Number of nodes with no children.
+     */
+    int leaves()
+    {
+        return (int)shape().leaves;
+    }
+
+    long long size() const { return count; }
+
+    /**
+     * Measures the tree in one pass: IPL, EPL, height, leaf count, the number
+     * of nodes at every depth, and how the IPL compares to a perfectly
+     * balanced tree and to the expected IPL of a random BST of the same size.
+     * Large trees are split into subtrees that are measured in parallel.
+     *
+     * Prefer this over calling ipl(), height() and leaves() separately, each
+     * of which is a full traversal.
+     */
+    ShapeStats shape() const
+    {
+        return _measure(root, count);
+    }
+
+    /**
+     * An immutable, reference-counted view of the tree as it was when
+     * snapshot() was called.
+     *
+     * Taking a snapshot is O(1): it only adds a reference to the root. While
+     * it is alive, inserts and deletes on the tree copy the nodes they would
+     * otherwise modify instead of changing them in place, so the snapshot
+     * keeps seeing the old version and readers never have to stop the I/D
+     * loop. Nodes that are no longer reachable from the tree or from any
+     * snapshot are freed when the last reference goes away.
+     *
+     * Any insert or delete made while a snapshot is alive invalidates all
+     * live-tree iterators and Ranges (see const_iterator). The snapshot has
+     * its own iterators, which stay valid for as long as the snapshot does.
+     *
+     * snapshot() itself must be called on the thread that mutates the tree;
+     * the returned object can then be read, copied and destroyed on any thread.
+     */
+    class Snapshot
+    {
+        friend class Bst;
+
+        Node *root;
+        long long count;
+
+        Snapshot(Node *r, long long n) : root(r), count(n)
+        {
+            if (root)
+            {
+                root->refs.fetch_add(1, memory_order_relaxed);
+            }
+        }
+
+    public:
+        Snapshot(const Snapshot &other) : Snapshot(other.root, other.count) {}
+        Snapshot(Snapshot &&other) noexcept : root(other.root), count(other.count)
+        {
+            other.root = nullptr;
+            other.count = 0;
+        }
+        Snapshot &operator=(Snapshot other)
+        {
+            swap(root, other.root);
+            swap(count, other.count);
+            return *this;
+        }
+        ~Snapshot()
+        {
+            if (root)
+            {
+                _release(root);
+            }
+        }
+
+        long long size() const { return count; }
+        ShapeStats shape() const { return _measure(root, count); }
+        int ipl() const { return (int)shape().ipl; }
+
+        /**
+         * Forward in-order iterator over a snapshot. Parent links are not
+         * valid inside a snapshot, so it carries the stack of ancestors whose
+         * left subtree it is in; the top of the stack is the current node.
+         */
+        class const_iterator
+        {
+            friend class Snapshot;
+
+            vector<const Node *> stack;
+
+            // Pushes node and its chain of left children
+            void _descend(const Node *node)
+            {
+                while (node)
+                {
+                    stack.push_back(node);
+                    node = node->left;
+                }
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = int;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const int *;
+            using reference = const int &;
+
+            reference operator*() const { return stack.back()->data; }
+            pointer operator->() const { return &stack.back()->data; }
+
+            const_iterator &operator++()
+            {
+                const Node *node = stack.back();
+                stack.pop_back();
+                _descend(node->right);
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                const_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const const_iterator &other) const
+            {
+                const Node *mine = stack.empty() ? nullptr : stack.back();
+                const Node *theirs = other.stack.empty() ? nullptr : other.stack.back();
+                return mine == theirs;
+            }
+            bool operator!=(const const_iterator &other) const { return !(*this == other); }
+        };
+        using iterator = const_iterator;
+
+        /**
+         * A half-open [first, last) slice of the snapshot usable with range-for.
+         */
+        struct Range
+        {
+            const_iterator first;
+            const_iterator last;
+
+            const_iterator begin() const { return first; }
+            const_iterator end() const { return last; }
+        };
+
+        const_iterator begin() const
+        {
+            const_iterator it;
+            it._descend(root);
+            return it;
+        }
+        const_iterator end() const { return const_iterator(); }
+
+        /**
+         * Returns an iterator to the first key that is not less than x.
+         */
+        const_iterator lower_bound(int x) const
+        {
+            const_iterator it;
+            const Node *node = root;
+            while (node)
+            {
+                if (node->data < x)
+                {
+                    node = node->right;
+                }
+                else
+                {
+                    it.stack.push_back(node);
+                    node = node->left;
+                }
+            }
+            return it;
+        }
+
+        /**
+         * Returns an iterator to the first key that is greater than x.
+         */
+        const_iterator upper_bound(int x) const
+        {
+            const_iterator it;
+            const Node *node = root;
+            while (node)
+            {
+                if (node->data <= x)
+                {
+                    node = node->right;
+                }
+                else
+                {
+                    it.stack.push_back(node);
+                    node = node->left;
+                }
+            }
+            return it;
+        }
+
+        /**
+         * Returns the keys k with a <= k < b in ascending order.
+         */
+        Range range(int a, int b) const
+        {
+            if (b <= a)
+            {
+                return Range{end(), end()};
+            }
+            return Range{lower_bound(a), lower_bound(b)};
+        }
+
+        /**
+         * Calls visit(key) for every key in ascending order.
+         */
+        template <typename Visit>
+        void inorder(Visit visit) const
+        {
+            for (int key : *this)
+            {
+                visit(key);
+            }
+        }
+
+        void print() const
+        {
+            inorder([](int key)
+                    { cout << key << " "; });
+        }
+
+        void saveDotFile(const std::string &filename) const
+        {
+            std::string dotContent = GraphvizBST::generateDot(root);
+            GraphvizBST::saveDotFile(filename, dotContent);
+        }
+    };
+
+    Snapshot snapshot() const
+    {
+        return Snapshot(root, count);
+    }
+
+private:
+    static ShapeStats _measure(const Node *subroot, long long count)
+    {
+        ShapeStats stats;
+        if (!subroot)
+        {
+            return stats;
+        }
+        if (count >= PARALLEL_SHAPE_THRESHOLD && thread::hardware_concurrency() > 1)
+        {
+            _shapeParallel(subroot, stats);
+        }
+        else
+        {
+            _shape(subroot, 0, stats);
+        }
+
+        stats.epl = stats.ipl + 2 * stats.nodes;
+        stats.height = (int)stats.depthHistogram.size() - 1;
+        long long optimal = _optimalIpl(stats.nodes);
+        double random = _randomIpl(stats.nodes);
+        stats.optimalRatio = optimal > 0 ? (double)stats.ipl / optimal : 1.0;
+        stats.randomRatio = random > 0 ? stats.ipl / random : 1.0;
+        return stats;
+    }
+};
+
+/**
+ * Running mean and variance using Welford's online algorithm, which is
+ * numerically stable and needs only three numbers regardless of sample count.
+ */
+class RunningStats
+{
+    long long n = 0;
+    double mean_ = 0.0;
+    double m2 = 0.0;
+
+public:
+    void add(double x)
+    {
+        n++;
+        double delta = x - mean_;
+        mean_ += delta / n;
+        m2 += delta * (x - mean_);
+    }
+
+    long long count() const { return n; }
+    double mean() const { return mean_; }
+    double variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+};
+
+/**
+ * Streaming estimate of a single quantile with the P-square algorithm
+ * (Jain & Chlamtac, 1985). Keeps five markers whose heights are adjusted
+ * with piecewise-parabolic interpolation, so memory is constant.
+ */
+class P2Quantile
+{
+    double p;
+    long long n = 0;
+    double q[5];     // marker heights
+    double pos[5];   // actual marker positions (1-based)
+    double want[5];  // desired marker positions
+    double step[5];  // increment of the desired positions per sample
+
+    double _parabolic(int i, double d) const
+    {
+        return q[i] + d / (pos[i + 1] - pos[i - 1]) *
+                          ((pos[i] - pos[i - 1] + d) * (q[i + 1] - q[i]) / (pos[i + 1] - pos[i]) +
+                           (pos[i + 1] - pos[i] - d) * (q[i] - q[i - 1]) / (pos[i] - pos[i - 1]));
+    }
+
+    double _linear(int i, int d) const
+    {
+        return q[i] + d * (q[i + d] - q[i]) / (pos[i + d] - pos[i]);
+    }
+
+public:
+    explicit P2Quantile(double quantile) : p(quantile) {}
+
+    void add(double x)
+    {
+        if (n < 5)
+        {
+            q[n++] = x;
+            if (n == 5)
+            {
+                sort(q, q + 5);
+                for (int i = 0; i < 5; i++)
+                {
+                    pos[i] = i + 1;
+                }
+                want[0] = 1;
+                want[1] = 1 + 2 * p;
+                want[2] = 1 + 4 * p;
+                want[3] = 3 + 2 * p;
+                want[4] = 5;
+                step[0] = 0;
+                step[1] = p / 2;
+                step[2] = p;
+                step[3] = (1 + p) / 2;
+                step[4] = 1;
+            }
+            return;
+        }
+
+        // Find the cell the sample falls into, stretching the extremes if needed
+        int k;
+        if (x < q[0])
+        {
+            q[0] = x;
+            k = 0;
+        }
+        else if (x >= q[4])
+        {
+            q[4] = x;
+            k = 3;
+        }
+        else
+        {
+            k = 0;
+            while (x >= q[k + 1])
+            {
+                k++;
+            }
+        }
+        for (int i = k + 1; i < 5; i++)
+        {
+            pos[i]++;
+        }
+        for (int i = 0; i < 5; i++)
+        {
+            want[i] += step[i];
+        }
+        n++;
+
+        // Nudge the three middle markers toward their desired positions
+        for (int i = 1; i <= 3; i++)
+        {
+            double d = want[i] - pos[i];
+            if ((d >= 1 && pos[i + 1] - pos[i] > 1) || (d <= -1 && pos[i - 1] - pos[i] < -1))
+            {
+                int ds = d > 0 ? 1 : -1;
+                double candidate = _parabolic(i, ds);
+                if (q[i - 1] < candidate && candidate < q[i + 1])
+                {
+                    q[i] = candidate;
+                }
+                else
+                {
+                    q[i] = _linear(i, ds);
+                }
+                pos[i] += ds;
+            }
+        }
+    }
+
+    double value() const
+    {
+        if (n == 0)
+        {
+            return NAN;
+        }
+        if (n < 5)
+        {
+            // Too few samples for the markers; answer exactly from what we have
+            double sorted[5];
+            copy(q, q + n, sorted);
+            sort(sorted, sorted + n);
+            return sorted[(int)lround(p * (n - 1))];
+        }
+        return q[2];
+    }
+};
+
+/**
+ * Streams IPL, height and leaf-count statistics of long I/D experiments to a CSV file.
+ *
+ * Samples are aggregated per (tree size, deletion strategy, step bucket), where
+ * a bucket groups `bucketWidth` consecutive I/D steps. Every aggregate is a fixed
+ * set of accumulators, so memory does not grow with the number of runs. Every
+ * `flushEvery` samples the aggregates that changed are appended to the file;
+ * the newest row for a key holds its current value, so a sweep can be watched
+ * (or plotted) while it is still running.
+ *
+ * Columns: flush,size,strategy,step,metric,count,mean,variance,p50,p90,p99
+ */
+class TelemetrySink
+{
+    struct Metric
+    {
+        RunningStats stats;
+        P2Quantile p50{0.5};
+        P2Quantile p90{0.9};
+        P2Quantile p99{0.99};
+
+        void add(double x)
+        {
+            stats.add(x);
+            p50.add(x);
+            p90.add(x);
+            p99.add(x);
+        }
+    };
+
+    struct Aggregate
+    {
+        Metric ipl;
+        Metric height;
+        Metric leaves;
+        bool dirty = false;
+    };
+
+    std::ofstream outFile;
+    int bucketWidth;
+    int flushEvery;
+    int pending = 0;
+    int flushCount = 0;
+    std::map<std::tuple<int, std::string, int>, Aggregate> aggregates;
+
+    void _writeRow(const std::tuple<int, std::string, int> &key, const char *name, const Metric &metric)
+    {
+        outFile << flushCount << ',' << std::get<0>(key) << ',' << std::get<1>(key) << ','
+                << std::get<2>(key) * bucketWidth << ',' << name << ','
+                << metric.stats.count() << ',' << metric.stats.mean() << ',' << metric.stats.variance() << ','
+                << metric.p50.value() << ',' << metric.p90.value() << ',' << metric.p99.value() << '\n';
+    }
+
+public:
+    TelemetrySink(const std::string &filename, int bucketWidth = 1, int flushEvery = 100)
+        : outFile(filename), bucketWidth(bucketWidth > 0 ? bucketWidth : 1), flushEvery(flushEvery)
+    {
+        if (outFile.is_open())
+        {
+            outFile << "flush,size,strategy,step,metric,count,mean,variance,p50,p90,p99\n";
+        }
+        else
+        {
+            std::cerr << "Error: Could not open file " << filename << std::endl;
+        }
+    }
+
+    ~TelemetrySink() { flush(); }
+
+    /**
+     * Records the current shape of a tree.
+     *
+     * @param size The nominal tree size of the experiment (64, 128, ...).
+     * @param strategy The deletion strategy, e.g. "symmetric" or "asymmetric".
+     * @param step The number of I/D pairs applied so far in this run.
+     * @param tree The tree to measure.
+     */
+    void record(int size, const std::string &strategy, int step, const Bst &tree)
+    {
+        Aggregate &agg = aggregates[std::make_tuple(size, strategy, step / bucketWidth)];
+        ShapeStats shape = tree.shape();
+        agg.ipl.add(shape.ipl);
+        agg.height.add(shape.height);
+        agg.leaves.add(shape.leaves);
+        agg.dirty = true;
+
+        if (++pending >= flushEvery)
+        {
+            flush();
+        }
+    }
+
+    /**
+     * Appends every aggregate that changed since the last flush to the file.
+     */
+    void flush()
+    {
+        if (!outFile.is_open() || pending == 0)
+        {
+            return;
+        }
+        for (auto &entry : aggregates)
+        {
+            if (!entry.second.dirty)
+            {
+                continue;
+            }
+            _writeRow(entry.first, "ipl", entry.second.ipl);
+            _writeRow(entry.first, "height", entry.second.height);
+            _writeRow(entry.first, "leaves", entry.second.leaves);
+            entry.second.dirty = false;
+        }
+        outFile.flush();
+        pending = 0;
+        flushCount++;
     }
 };
 
@@ -425,6 +1402,12 @@ int main()
     cout << "Internal Path Length: " << tree64.ipl() << endl;
     tree64.saveDotFile("bst64_snapshot.dot");
 
+    // Keeps the starting tree readable while the I/D loop below mutates tree64
+    Bst::Snapshot before = tree64.snapshot();
+
+    TelemetrySink telemetry("bst_telemetry.csv", 10);
+    telemetry.record(64, "symmetric", 0, tree64);
+
     // for (int i = 1; i < 60; i++)
     // {
     //     tree64.delete_asymmetric(&arr64);
@@ -433,11 +1416,13 @@ int main()
     {
         tree64.delete_symmetric(&arr64);   
         cout << "Out" << endl; 
+        telemetry.record(64, "symmetric", i + 1, tree64);
     }
     
 
     cout << "Size of arr64: " << arr64.size() << endl;
 
+    cout << "Internal Path Length (before I/D): " << before.ipl() << endl;
     cout << "Internal Path Length: " << tree64.ipl() << endl;
     tree64.saveDotFile("bst64_D_snapshot.dot");
 